@@ -1,5 +1,7 @@
+import os
+import zlib
 import numpy as np
-from scipy.sparse import coo_matrix
+from scipy.sparse import coo_matrix, csr_matrix
 
 def LoadCoo(filename):
     rawMat = np.loadtxt(filename,
@@ -12,3 +14,135 @@ def LoadCoo(filename):
 def LoadVec(filename):
     return np.loadtxt(filename)
 
+def LoadCsr(filename):
+    """Map a .csr file written by convertSystem -format csr."""
+    raw = np.memmap(filename, dtype=np.uint8, mode='r')
+    header = raw[:32].view(dtype=[("magic", "S8"), ("indexSize", "u4"),
+                                  ("valueSize", "u4"), ("nRows", "u8"),
+                                  ("nnz", "u8")])[0]
+    if header["magic"] != b"FOAMCSR":
+        raise ValueError("%s is not a CSR file" % filename)
+    indexType = np.dtype("i%d" % header["indexSize"])
+    valueType = np.dtype("f%d" % header["valueSize"])
+    nRows = int(header["nRows"])
+    nnz = int(header["nnz"])
+
+    def pad8(n):
+        return (n + 7) & ~7
+    rowStart = 32
+    colStart = pad8(rowStart + (nRows + 1) * indexType.itemsize)
+    valStart = pad8(colStart + nnz * indexType.itemsize)
+    return csr_matrix(
+        (raw[valStart:valStart + nnz * valueType.itemsize].view(valueType),
+         raw[colStart:colStart + nnz * indexType.itemsize].view(indexType),
+         raw[rowStart:rowStart + (nRows + 1) * indexType.itemsize].view(indexType)),
+        shape=(nRows, nRows))
+
+
+
+# A record of MatrixExtractingSolver's binary solve log (see SolveLog.H)
+_SOLVE_LOG_RECORD = np.dtype([
+    ("field", "S32"), ("timeIndex", "i8"), ("time", "f8"),
+    ("subCycle", "i4"), ("nIterations", "i4"), ("workerTime", "f8"),
+    ("initialResidual", "f8"), ("finalResidual", "f8"),
+    ("nCells", "i8"), ("nnz", "i8"), ("nInterfaces", "i4"),
+    ("written", "i4"), ("nInterfaceCoeffs", "i8"), ("extractTime", "f8"),
+    ("bytesWritten", "u8")])
+
+def LoadSolveLog(filename):
+    """Map a solveLog.bin file. Returns a numpy structured array with
+    one record per solve."""
+    raw = np.memmap(filename, dtype=np.uint8, mode='r')
+    header = raw[:16].view(dtype=[("magic", "S8"), ("version", "u4"),
+                                  ("recordSize", "u4")])[0]
+    if header["magic"] != b"FOAMLOG":
+        raise ValueError("%s is not a solve log" % filename)
+    if header["recordSize"] != _SOLVE_LOG_RECORD.itemsize:
+        raise ValueError("%s has %d byte records, expected %d"
+                         % (filename, header["recordSize"],
+                            _SOLVE_LOG_RECORD.itemsize))
+    # Ignore a partial record left by a run that died mid-write
+    n = (raw.size - 16) // _SOLVE_LOG_RECORD.itemsize
+    return raw[16:16 + n * _SOLVE_LOG_RECORD.itemsize].view(_SOLVE_LOG_RECORD)
+
+# Block type codes in the binary .system container (see SystemFile.H)
+_SYSTEM_BLOCKS = {
+    1: "source",
+    2: "diag",
+    3: "upper",
+    4: "lower",
+    5: "upperAddr",
+    6: "lowerAddr",
+    7: "localCellIds",
+    8: "coeffs",
+    10: "cellMap",
+    }
+_LABEL_BLOCKS = (5, 6, 7, 10)
+_REFERENCE = 9
+_COMPRESSED = 0x100
+_XOR_DELTA = 0x200
+_ENCODING_MASK = 0xff00
+
+def _Store(system, name, key, data):
+    if key >= 0:
+        system["interfaces"].setdefault(key, {})[name] = data
+    else:
+        system[name] = data
+
+def LoadSystem(filename):
+    """Map a binary .system file. Returns a dict of numpy arrays; the
+    per-processor interfaces, if any, are in a sub-dict under
+    "interfaces" keyed by neighbour processor number. Shared topology
+    and delta encoded coefficients are resolved."""
+    raw = np.memmap(filename, dtype=np.uint8, mode='r')
+    header = raw[:48].view(dtype=[("magic", "S8"), ("version", "u4"),
+                                  ("byteOrder", "u4"), ("labelSize", "u2"),
+                                  ("scalarSize", "u2"), ("nBlocks", "u4"),
+                                  ("topology", "u8"), ("reserved", "u8", 2)])[0]
+    if header["magic"] != b"FOAMSYS":
+        raise ValueError("%s is not a binary system file" % filename)
+    labelType = np.dtype("i%d" % header["labelSize"])
+    scalarType = np.dtype("f%d" % header["scalarSize"])
+    table = raw[48:48 + 24 * header["nBlocks"]].view(
+        dtype=[("type", "u4"), ("key", "i4"), ("offset", "u8"), ("count", "u8")])
+
+    # The system is in a time directory under the case directory
+    caseDir = os.path.dirname(os.path.dirname(os.path.abspath(filename)))
+
+    system = {"interfaces": {}}
+    if header["version"] >= 2 and header["topology"]:
+        topology = LoadSystem(os.path.join(caseDir, "systemTopology",
+                                           "%016x.topology" % header["topology"]))
+        for name in ("upperAddr", "lowerAddr"):
+            system[name] = topology[name]
+        for key, interface in topology["interfaces"].items():
+            system["interfaces"].setdefault(key, {}).update(interface)
+
+    reference = None
+    for block in table:
+        if block["type"] == _REFERENCE:
+            start = int(block["offset"])
+            refName = raw[start:start + int(block["count"])].tobytes().decode()
+            reference = LoadSystem(os.path.join(caseDir, refName))
+
+    for block in table:
+        baseType = int(block["type"]) & ~_ENCODING_MASK
+        name = _SYSTEM_BLOCKS.get(baseType)
+        if name is None:
+            continue
+        key = int(block["key"])
+        dtype = labelType if baseType in _LABEL_BLOCKS else scalarType
+        start = int(block["offset"])
+        count = int(block["count"])
+        if block["type"] & _COMPRESSED:
+            size = int(raw[start:start + 8].view("u8")[0])
+            data = np.frombuffer(zlib.decompress(raw[start + 8:start + 8 + size].tobytes()),
+                                 dtype=np.uint8).copy()
+            if block["type"] & _XOR_DELTA:
+                previous = reference["interfaces"][key][name] if key >= 0 else reference[name]
+                data ^= previous.view(np.uint8)
+            data = data.view(dtype)
+        else:
+            data = raw[start:start + count * dtype.itemsize].view(dtype)
+        _Store(system, name, key, data)
+    return system